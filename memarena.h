@@ -29,6 +29,10 @@
 # include <string.h>
 # include <stdbool.h>
 # include <stdarg.h>
+# include <fcntl.h>
+# ifdef __linux__
+#  include <sys/syscall.h>
+# endif
 
 /* --- Versioning --- */
 #define MEMARENA_VERSION_MAJOR 1
@@ -54,16 +58,39 @@ typedef struct {
 // To disable dynamic resizing (effectively allow only one ArenaBlock)
 // #define MEMARENA_DISABLE_RESIZE	
 
+// Hardened mode for production: PROT_NONE guard pages around every ArenaBlock,
+// and large allocations get their own block ending right at the guard page
+// (not with MEMARENA_DISABLE_RESIZE, where they share the single block)
+// #define MEMARENA_GUARD_PAGES
+
+// Page-aligns arena_temp_begin and makes rolled-back temp memory PROT_NONE
+// until it is allocated again
+// #define MEMARENA_GUARD_TEMP
+
 #ifndef MEMARENA_DEFAULT_SIZE
   #define MEMARENA_DEFAULT_SIZE (64 * 1024 * 1024)
 #endif
 
+#ifndef MEMARENA_GUARD_LARGE_SIZE
+  #define MEMARENA_GUARD_LARGE_SIZE (1024 * 1024)
+#endif
+
+// First step MEMARENA_GUARD_TEMP unprotects when reusing rolled-back memory
+#ifndef MEMARENA_GUARD_TEMP_STEP
+  #define MEMARENA_GUARD_TEMP_STEP (64 * 1024)
+#endif
+
 #define DEFAULT_ALIGNMENT 8
 #define is_power_of_two(x) ((x != 0) && ((x & (x - 1)) == 0))
 
 //* --- ASAN Support --- *//
-#if defined(__SANITIZE_ADDRESS__) || defined(ADDRESS_SANITIZER) \
-	|| (defined(__has_feature) && __has_feature(address_sanitizer))
+// __has_feature has to be tested on its own line, GCC can't parse it otherwise
+#if defined(__has_feature)
+  #if __has_feature(address_sanitizer)
+    #define MEMARENA_HAS_ASAN
+  #endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(ADDRESS_SANITIZER) || defined(MEMARENA_HAS_ASAN)
   #include <sanitizer/asan_interface.h>
   #ifndef ASAN_POISON_MEMORY_REGION
     #define ASAN_POISON_MEMORY_REGION(addr, size) \
@@ -82,23 +109,38 @@ typedef struct {
 
 
 
+// Arena flags
+#define ARENA_FLAG_COW		0x01	// Blocks are memfd-backed, arena can be snapshotted
+#define ARENA_FLAG_SNAPSHOT	0x02	// A snapshot is currently active
+
 /* --- Structs --- */
 typedef struct ArenaBlock ArenaBlock;
 
 struct ArenaBlock
 {
-ArenaBlock	*prev;
+	ArenaBlock	*prev;
 	size_t		size;
 	size_t		offset;
+	int			fd;		// Backing memfd for COW arenas, -1 otherwise
+	int			commit_fd;	// New memfd while arena_snapshot_commit copies, -1 otherwise
+	bool		borrowed;	// Lives in a caller-supplied buffer, never unmapped
+#ifdef MEMARENA_GUARD_TEMP
+	size_t		guard_lo;	// Rolled-back range currently PROT_NONE,
+	size_t		guard_hi;	// as offsets into the block (empty if equal)
+	size_t		guard_step;	// Bytes unprotected by the last arena_guard_reuse
+#endif
 };
 
 typedef struct {
 	ArenaBlock	*curr;
+	ArenaBlock	*large;	// Dedicated guarded blocks (MEMARENA_GUARD_PAGES only)
 	int			prot;
+	int			flags;
 } Arena;
 
 typedef struct {
 	ArenaBlock	*block;
+	ArenaBlock	*large;
 	size_t		offset;
 } ArenaPos;
 
@@ -107,8 +149,30 @@ typedef struct {
 	ArenaPos	pos;
 } ArenaTemp;
 
+typedef struct {
+	Arena		*arena;	// NULL if taking the snapshot failed
+	ArenaPos	pos;
+} ArenaSnapshot;
+
+// FIFO arena over a double-mapped region. head and tail count bytes ever
+// allocated / released, so head - tail is the amount currently in use.
+typedef struct {
+	char		*base;	// NULL if init failed
+	size_t		size;
+	size_t		head;	// Only written by the producer
+	size_t		tail __attribute__((aligned(64)));	// Only written by the consumer
+	int			fd;
+	int			prot;
+} ArenaRing;
+
 /* --- API prototypes --- */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 Arena			arena_init(int prot);
+Arena			arena_init_cow(int prot);
+Arena			arena_init_buffer(void *buf, size_t size, int prot);
 void			arena_free(Arena *a);
 void			arena_reset(Arena *a);
 
@@ -122,6 +186,19 @@ void			*arena_realloc_aligned(Arena *a, void *ptr, size_t old_size, size_t new_s
 ArenaTemp		arena_temp_begin(Arena *a);
 void			arena_temp_end(ArenaTemp temp);
 
+// Copy-on-write snapshots, only for arenas created with arena_init_cow
+ArenaSnapshot	arena_snapshot(Arena *a);
+bool			arena_snapshot_restore(ArenaSnapshot snap);
+bool			arena_snapshot_commit(ArenaSnapshot snap);
+
+// Ring arena; safe with one producer thread (alloc) and one consumer thread (release)
+ArenaRing		arena_ring_init(size_t size, int prot);
+void			arena_ring_free(ArenaRing *r);
+void			*arena_ring_alloc(ArenaRing *r, size_t size);
+void			*arena_ring_alloc_aligned(ArenaRing *r, size_t size, size_t align);
+bool			arena_ring_release(ArenaRing *r, void *ptr);
+size_t			arena_ring_used(ArenaRing *r);
+
 size_t			arena_total_used(Arena *a);
 bool			arena_set_prot(Arena *a, int prot);
 void			arena_print_stats(Arena *a);
@@ -130,6 +207,10 @@ MemArenaVersion	arena_get_version(void);
 // Sprintf that allocates to the arena
 char			*arena_sprintf(Arena *a, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // MEMARENA_H
 
 /* ========================================================================= */
@@ -171,20 +252,82 @@ static uintptr_t align_forward(uintptr_t ptr, size_t align)
     return (ptr);
 }
 
-static ArenaBlock *arena_create_block(size_t capacity, int prot, ArenaBlock *prev_block) 
+// Anonymous file to back COW blocks; shm_open fallback where memfd is missing
+static int arena_memfd_create(size_t size)
+{
+	int fd = -1;
+#ifdef SYS_memfd_create
+	fd = (int)syscall(SYS_memfd_create, "memarena", 1U /* MFD_CLOEXEC */);
+#else
+	char name[64];
+	snprintf(name, sizeof(name), "/memarena-%ld-%p", (long)getpid(), (void *)&name);
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd != -1)
+		shm_unlink(name);
+#endif
+	if (fd == -1)
+		return (-1);
+	if (ftruncate(fd, (off_t)size) == -1)
+	{
+		close(fd);
+		return (-1);
+	}
+	return (fd);
+}
+
+static size_t arena_guard_size(void)
+{
+#ifdef MEMARENA_GUARD_PAGES
+	return (get_page_size());
+#else
+	return (0);
+#endif
+}
+
+static ArenaBlock *arena_create_block(size_t capacity, int prot, int flags, ArenaBlock *prev_block) 
 {
     void *hint_addr = NULL;
-    if (prev_block)
+    if (prev_block && !prev_block->borrowed)
         hint_addr = (void *)((char *)prev_block + prev_block->size);
 
     size_t total_needed = capacity + sizeof(ArenaBlock);
     size_t total_size = align_to_page(total_needed);
 
-    void *base = mmap(hint_addr, total_size, prot, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	// Guarded blocks are mapped into a PROT_NONE reservation one page larger on both sides
+	size_t guard = arena_guard_size();
+	char *reserve = NULL;
+	int map_fixed = 0;
+	if (guard)
+	{
+		reserve = mmap(NULL, total_size + guard * 2, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (reserve == MAP_FAILED)
+			return (NULL);
+		hint_addr = reserve + guard;
+		map_fixed = MAP_FIXED;
+	}
+
+	int fd = -1;
+	void *base;
+	if (flags & ARENA_FLAG_COW)
+	{
+		fd = arena_memfd_create(total_size);
+		base = (fd == -1) ? MAP_FAILED
+			: mmap(hint_addr, total_size, prot, MAP_SHARED | map_fixed, fd, 0);
+	}
+	else
+		base = mmap(hint_addr, total_size, prot, MAP_ANONYMOUS | MAP_PRIVATE | map_fixed, -1, 0);
     if (base == MAP_FAILED)
+	{
+		if (fd != -1)
+			close(fd);
+		if (reserve)
+			munmap(reserve, total_size + guard * 2);
         return (NULL);
+	}
     
-    if (prev_block && base == hint_addr)
+	// Each memfd block maps its own file, so those can never be merged
+    if (prev_block && base == hint_addr && !guard && fd == -1 && prev_block->fd == -1
+		&& !prev_block->borrowed)
 	{
         prev_block->size += total_size;
         ASAN_POISON_MEMORY_REGION(base, total_size);
@@ -195,46 +338,287 @@ static ArenaBlock *arena_create_block(size_t capacity, int prot, ArenaBlock *pre
     block->prev = prev_block;
     block->size = total_size;
     block->offset = sizeof(ArenaBlock);
+	block->fd = fd;
+	block->commit_fd = -1;
+	block->borrowed = false;
+#ifdef MEMARENA_GUARD_TEMP
+	block->guard_lo = 0;
+	block->guard_hi = 0;
+	block->guard_step = 0;
+#endif
 
     ASAN_POISON_MEMORY_REGION((char *)base + sizeof(ArenaBlock), total_size - sizeof(ArenaBlock));
     return (block);
 }
 
+static void arena_release_block(ArenaBlock *block)
+{
+	// Unmapped addresses get reused by later mmaps, so don't leave stale poison behind
+	ASAN_UNPOISON_MEMORY_REGION(block, block->size);
+	if (block->borrowed)
+		return;
+	int fd = block->fd;
+	size_t guard = arena_guard_size();
+	munmap((char *)block - guard, block->size + guard * 2);
+	if (fd != -1)
+		close(fd);
+}
+
+#ifdef MEMARENA_GUARD_TEMP
+// Makes the whole pages of [from, to) inaccessible until they are handed out again
+static void arena_guard_rollback(ArenaBlock *block, size_t from, size_t to)
+{
+	if (block->borrowed)
+		return;
+	size_t lo = align_to_page(from);
+	size_t hi = align_to_page(to);
+	if (hi > block->size)
+		hi = block->size;
+	// Allocation always unprotects from the bottom, so the ranges stay contiguous
+	if (block->guard_hi > block->guard_lo)
+	{
+		lo = (lo < block->guard_lo) ? lo : block->guard_lo;
+		hi = (hi > block->guard_hi) ? hi : block->guard_hi;
+	}
+	if (lo >= hi)
+		return;
+	if (mprotect((char *)block + lo, hi - lo, PROT_NONE) == 0)
+	{
+		block->guard_lo = lo;
+		block->guard_hi = hi;
+		block->guard_step = 0;
+	}
+}
+
+// Called before the bytes up to offset end are handed out from the block.
+// Unprotects in doubling steps, so refilling a rolled-back scope costs
+// O(log n) mprotect calls instead of one per page.
+// Returns false if the pages could not be made accessible again.
+static bool arena_guard_reuse(ArenaBlock *block, size_t end, int prot)
+{
+	if (end <= block->guard_lo || block->guard_hi <= block->guard_lo)
+		return (true);
+	size_t step = block->guard_step ? block->guard_step * 2 : MEMARENA_GUARD_TEMP_STEP;
+	size_t hi = align_to_page(end);
+	if (hi - block->guard_lo < step)
+		hi = align_to_page(block->guard_lo + step);
+	if (hi > block->guard_hi)
+		hi = block->guard_hi;
+	if (mprotect((char *)block + block->guard_lo, hi - block->guard_lo, prot) == -1)
+		return (false);
+	block->guard_step = hi - block->guard_lo;
+	block->guard_lo = hi;
+	return (true);
+}
+
+// Puts the protection back after the whole block was mprotect'ed or remapped
+static void arena_guard_reapply(ArenaBlock *block)
+{
+	if (block->guard_hi > block->guard_lo)
+		mprotect((char *)block + block->guard_lo, block->guard_hi - block->guard_lo, PROT_NONE);
+}
+#endif
+
+// Replaces the mapping of a memfd block in place, keeping its address
+static bool arena_remap_block(ArenaBlock *block, int prot, int map_flags)
+{
+	size_t size = block->size;
+	int fd = block->fd;
+	void *res = mmap(block, size, prot, map_flags | MAP_FIXED, fd, 0);
+	return (res != MAP_FAILED);
+}
+
+// Unmaps blocks from block down to (but not including) stop
+static void arena_release_chain(ArenaBlock *block, ArenaBlock *stop)
+{
+	while (block && block != stop)
+	{
+		ArenaBlock *prev = block->prev;
+		arena_release_block(block);
+		block = prev;
+	}
+}
+
+// Remaps blocks from block down to stop; returns the block that failed, or NULL
+static ArenaBlock *arena_remap_chain(ArenaBlock *block, ArenaBlock *stop, int prot, int map_flags)
+{
+	for (; block && block != stop; block = block->prev)
+	{
+		if (!arena_remap_block(block, prot, map_flags))
+			return (block);
+#ifdef MEMARENA_GUARD_TEMP
+		arena_guard_reapply(block);
+#endif
+	}
+	return (NULL);
+}
+
+// Copies the used part of each block into a fresh memfd kept in commit_fd
+static ArenaBlock *arena_commit_copy_chain(ArenaBlock *block)
+{
+	for (; block; block = block->prev)
+	{
+		size_t used = block->offset;
+		size_t written = 0;
+		int fd = arena_memfd_create(block->size);
+		if (fd == -1)
+			return (block);
+		ASAN_UNPOISON_MEMORY_REGION(block, used);
+		while (written < used)
+		{
+			ssize_t res = pwrite(fd, (char *)block + written, used - written, (off_t)written);
+			if (res <= 0)
+				break;
+			written += (size_t)res;
+		}
+		if (written != used)
+		{
+			close(fd);
+			return (block);
+		}
+		block->commit_fd = fd;
+	}
+	return (NULL);
+}
+
+static void arena_commit_cancel_chain(ArenaBlock *block, ArenaBlock *stop)
+{
+	for (; block && block != stop; block = block->prev)
+	{
+		close(block->commit_fd);
+		block->commit_fd = -1;
+	}
+}
+
+// Swaps every block over to its commit_fd and shares it again
+static bool arena_commit_swap_chain(ArenaBlock *block, int prot)
+{
+	bool ok = true;
+	for (; block; block = block->prev)
+	{
+		int old_fd = block->fd;
+		int new_fd = block->commit_fd;
+		block->fd = new_fd;
+		if (!arena_remap_block(block, prot, MAP_SHARED))
+			ok = false;
+		// The copied header still names the old memfd
+		block->fd = new_fd;
+		block->commit_fd = -1;
+		close(old_fd);
+#ifdef MEMARENA_GUARD_TEMP
+		arena_guard_reapply(block);
+#endif
+	}
+	return (ok);
+}
+
+#if defined(MEMARENA_GUARD_PAGES) && !defined(MEMARENA_DISABLE_RESIZE)
+// Gives a large allocation its own block and pushes it against the trailing
+// guard page, so an overrun faults on its first byte past the page. These
+// blocks live on their own list, so small allocations keep filling a->curr.
+static void *arena_alloc_guarded(Arena *a, size_t size, size_t align)
+{
+	ArenaBlock *block = arena_create_block(size + align, a->prot, a->flags, a->large);
+	if (!block)
+		return (NULL);
+	uintptr_t block_end = (uintptr_t)block + block->size;
+	void *ptr = (void *)((block_end - size) & ~(uintptr_t)(align - 1));
+	block->offset = block->size;
+	a->large = block;
+	ASAN_UNPOISON_MEMORY_REGION(ptr, size);
+	return (ptr);
+}
+#endif
+
 /* --- API Implementation --- */
 Arena arena_init(int prot)
 {
     Arena a = {0};
     a.prot = prot;
 #ifdef MEMARENA_DISABLE_RESIZE
-    a.curr = arena_create_block(MEMARENA_DEFAULT_SIZE, prot, NULL);
+    a.curr = arena_create_block(MEMARENA_DEFAULT_SIZE, prot, a.flags, NULL);
 #endif
     return (a);
 }
 
+Arena arena_init_cow(int prot)
+{
+	Arena a = {0};
+	a.prot = prot;
+	a.flags = ARENA_FLAG_COW;
+#ifdef MEMARENA_DISABLE_RESIZE
+	a.curr = arena_create_block(MEMARENA_DEFAULT_SIZE, prot, a.flags, NULL);
+#endif
+	return (a);
+}
+
+/*
+   Uses buf as the first block, so small arenas need no syscalls at all.
+   Overflowing allocations spill into regular mmap'd blocks (unless
+   MEMARENA_DISABLE_RESIZE is defined). buf must outlive the arena and is
+   never unmapped; arena_reset goes back to it.
+*/
+Arena arena_init_buffer(void *buf, size_t size, int prot)
+{
+	Arena a = {0};
+	a.prot = prot;
+	if (!buf)
+		return (a);
+
+	uintptr_t start = align_forward((uintptr_t)buf, DEFAULT_ALIGNMENT);
+	size_t padding = start - (uintptr_t)buf;
+	if (size < padding + sizeof(ArenaBlock))
+		return (a);
+
+	ArenaBlock *block = (ArenaBlock *)start;
+	block->prev = NULL;
+	block->size = size - padding;
+	block->offset = sizeof(ArenaBlock);
+	block->fd = -1;
+	block->commit_fd = -1;
+	block->borrowed = true;
+#ifdef MEMARENA_GUARD_TEMP
+	block->guard_lo = 0;
+	block->guard_hi = 0;
+	block->guard_step = 0;
+#endif
+	ASAN_POISON_MEMORY_REGION((char *)block + sizeof(ArenaBlock), block->size - sizeof(ArenaBlock));
+	a.curr = block;
+	return (a);
+}
+
 void arena_free(Arena *a)
 {
     ArenaBlock *curr = a->curr;
     while (curr)
 	{
         ArenaBlock *prev = curr->prev;
-        munmap(curr, curr->size);
+        arena_release_block(curr);
         curr = prev;
     }
     a->curr = NULL;
+	arena_release_chain(a->large, NULL);
+	a->large = NULL;
+	a->flags &= ~ARENA_FLAG_SNAPSHOT;
 }
 
 void arena_reset(Arena *a)
 {
+	arena_release_chain(a->large, NULL);
+	a->large = NULL;
     if (!a->curr)
 		return;
     ArenaBlock *curr = a->curr;
     while (curr->prev != NULL)
 	{
         ArenaBlock *prev = curr->prev;
-        munmap(curr, curr->size);
+        arena_release_block(curr);
         curr = prev;
     }
     a->curr = curr;
+#ifdef MEMARENA_GUARD_TEMP
+	arena_guard_rollback(a->curr, sizeof(ArenaBlock), a->curr->offset);
+#endif
     a->curr->offset = sizeof(ArenaBlock);
     ASAN_POISON_MEMORY_REGION((char*)a->curr + sizeof(ArenaBlock), a->curr->size - sizeof(ArenaBlock));
 }
@@ -251,13 +635,18 @@ void *arena_alloc_aligned(Arena *a, size_t size, size_t align)
     if (!is_power_of_two(align))
 		return (NULL);
 
+#if defined(MEMARENA_GUARD_PAGES) && !defined(MEMARENA_DISABLE_RESIZE)
+	if (size >= MEMARENA_GUARD_LARGE_SIZE)
+		return (arena_alloc_guarded(a, size, align));
+#endif
+
     if (a->curr == NULL)
 	{
 #ifdef MEMARENA_DISABLE_RESIZE
         return (NULL);
 #else
         size_t block_size = (size > MEMARENA_DEFAULT_SIZE) ? size : MEMARENA_DEFAULT_SIZE;
-        a->curr = arena_create_block(block_size, a->prot, NULL);
+        a->curr = arena_create_block(block_size, a->prot, a->flags, NULL);
         if (!a->curr)
 			return (NULL);
 #endif
@@ -275,7 +664,7 @@ void *arena_alloc_aligned(Arena *a, size_t size, size_t align)
 #else
         size_t needed = size + align;
         size_t next_size = (needed > MEMARENA_DEFAULT_SIZE) ? needed : MEMARENA_DEFAULT_SIZE;
-        ArenaBlock *new_block = arena_create_block(next_size, a->prot, a->curr);
+        ArenaBlock *new_block = arena_create_block(next_size, a->prot, a->flags, a->curr);
         if (!new_block)
 			return (NULL);
         
@@ -290,6 +679,10 @@ void *arena_alloc_aligned(Arena *a, size_t size, size_t align)
 #endif
     }
 
+#ifdef MEMARENA_GUARD_TEMP
+	if (!arena_guard_reuse(a->curr, a->curr->offset + padding + size, a->prot))
+		return (NULL);
+#endif
     a->curr->offset += padding;
     void *ptr = (void *)(base_addr + a->curr->offset);
     ASAN_UNPOISON_MEMORY_REGION(ptr, size);
@@ -351,6 +744,10 @@ void *arena_realloc_aligned(Arena *a, void *ptr, size_t old_size, size_t new_siz
 			size_t diff = new_size - old_size;
 			if (a->curr->offset + diff <= a->curr->size)
 			{
+#ifdef MEMARENA_GUARD_TEMP
+				if (!arena_guard_reuse(a->curr, a->curr->offset + diff, a->prot))
+					return (NULL);
+#endif
 				a->curr->offset += diff;
 				ASAN_UNPOISON_MEMORY_REGION((void *)ptr_end, diff);
 				return (ptr);
@@ -372,13 +769,25 @@ ArenaTemp arena_temp_begin(Arena *a)
 {
     ArenaTemp temp = {0};
     temp.arena = a;
+#ifdef MEMARENA_GUARD_TEMP
+	// Start the scope on a fresh page so all of it can be protected on rollback
+	if (a->curr && !a->curr->borrowed)
+	{
+		size_t page_offset = align_to_page(a->curr->offset);
+		if (page_offset <= a->curr->size)
+			a->curr->offset = page_offset;
+	}
+#endif
     temp.pos.block = a->curr;
+    temp.pos.large = a->large;
     temp.pos.offset = a->curr ? a->curr->offset : 0;
     return (temp);
 }
 
 void arena_temp_end(ArenaTemp temp)
 {
+	arena_release_chain(temp.arena->large, temp.pos.large);
+	temp.arena->large = temp.pos.large;
     if (!temp.arena->curr)
 		return;
     ArenaBlock *curr = temp.arena->curr;
@@ -387,7 +796,7 @@ void arena_temp_end(ArenaTemp temp)
         if (curr->prev == NULL)
 			return;
         ArenaBlock *prev = curr->prev;
-        munmap(curr, curr->size);
+        arena_release_block(curr);
         curr = prev;
     }
     temp.arena->curr = temp.pos.block;
@@ -395,6 +804,9 @@ void arena_temp_end(ArenaTemp temp)
 	{
         size_t old_offset = temp.arena->curr->offset;
         temp.arena->curr->offset = temp.pos.offset;
+#ifdef MEMARENA_GUARD_TEMP
+		arena_guard_rollback(temp.arena->curr, temp.pos.offset, old_offset);
+#endif
         ASAN_POISON_MEMORY_REGION(
 				(char *)temp.arena->curr + temp.pos.offset,
 				old_offset - temp.pos.offset);
@@ -402,6 +814,281 @@ void arena_temp_end(ArenaTemp temp)
 	}
 }
 
+/*
+   Snapshots turn every existing block into a MAP_PRIVATE mapping of its memfd
+   at the same address. Writes after that land on private copy-on-write pages
+   while the memfd keeps the snapshotted contents, so taking a snapshot costs
+   one mmap per block instead of a copy. Only one snapshot can be active.
+*/
+ArenaSnapshot arena_snapshot(Arena *a)
+{
+	ArenaSnapshot snap = {0};
+	if (!(a->flags & ARENA_FLAG_COW) || (a->flags & ARENA_FLAG_SNAPSHOT))
+		return (snap);
+
+	// On failure nothing was written yet, so the shared view is still identical
+	ArenaBlock *failed = arena_remap_chain(a->curr, NULL, a->prot, MAP_PRIVATE);
+	if (failed)
+	{
+		arena_remap_chain(a->curr, failed, a->prot, MAP_SHARED);
+		return (snap);
+	}
+	failed = arena_remap_chain(a->large, NULL, a->prot, MAP_PRIVATE);
+	if (failed)
+	{
+		arena_remap_chain(a->curr, NULL, a->prot, MAP_SHARED);
+		arena_remap_chain(a->large, failed, a->prot, MAP_SHARED);
+		return (snap);
+	}
+	a->flags |= ARENA_FLAG_SNAPSHOT;
+	snap.arena = a;
+	snap.pos.block = a->curr;
+	snap.pos.large = a->large;
+	snap.pos.offset = a->curr ? a->curr->offset : 0;
+	return (snap);
+}
+
+// Drops everything done since the snapshot; pointers from before it stay valid
+bool arena_snapshot_restore(ArenaSnapshot snap)
+{
+	Arena *a = snap.arena;
+	if (!a || !(a->flags & ARENA_FLAG_SNAPSHOT))
+		return (false);
+
+	arena_release_chain(a->curr, snap.pos.block);
+	arena_release_chain(a->large, snap.pos.large);
+	a->curr = snap.pos.block;
+	a->large = snap.pos.large;
+
+	// Headers live inside the mapping, so this also restores the offsets
+	bool ok = !arena_remap_chain(a->curr, NULL, a->prot, MAP_SHARED)
+		&& !arena_remap_chain(a->large, NULL, a->prot, MAP_SHARED);
+	for (int i = 0; i < 2; ++i)
+	{
+		for (ArenaBlock *curr = i ? a->large : a->curr; curr; curr = curr->prev)
+		{
+			// Shrinks or rollbacks after the snapshot may have poisoned restored data
+			ASAN_UNPOISON_MEMORY_REGION((char *)curr + sizeof(ArenaBlock), curr->offset - sizeof(ArenaBlock));
+			ASAN_POISON_MEMORY_REGION((char *)curr + curr->offset, curr->size - curr->offset);
+		}
+	}
+	a->flags &= ~ARENA_FLAG_SNAPSHOT;
+	return (ok);
+}
+
+/*
+   Keeps everything done since the snapshot. The used part of each old block
+   is copied into a fresh memfd first and only swapped in once every copy
+   succeeded, so on failure the snapshot is still active and restorable.
+   Blocks created after the snapshot are already shared and left alone.
+*/
+bool arena_snapshot_commit(ArenaSnapshot snap)
+{
+	Arena *a = snap.arena;
+	if (!a || !(a->flags & ARENA_FLAG_SNAPSHOT))
+		return (false);
+
+	ArenaBlock *failed = arena_commit_copy_chain(snap.pos.block);
+	if (failed)
+	{
+		arena_commit_cancel_chain(snap.pos.block, failed);
+		return (false);
+	}
+	failed = arena_commit_copy_chain(snap.pos.large);
+	if (failed)
+	{
+		arena_commit_cancel_chain(snap.pos.block, NULL);
+		arena_commit_cancel_chain(snap.pos.large, failed);
+		return (false);
+	}
+
+	bool ok = arena_commit_swap_chain(snap.pos.block, a->prot);
+	if (!arena_commit_swap_chain(snap.pos.large, a->prot))
+		ok = false;
+	a->flags &= ~ARENA_FLAG_SNAPSHOT;
+	return (ok);
+}
+
+/*
+   The same memfd pages are mapped twice back to back, so an allocation that
+   starts near the end of the ring simply continues into the second view and
+   never has to wrap. Allocation advances head, release advances tail.
+*/
+ArenaRing arena_ring_init(size_t size, int prot)
+{
+	ArenaRing r = {0};
+	r.fd = -1;
+	r.prot = prot;
+	if (size == 0)
+		return (r);
+	size = align_to_page(size);
+
+	int fd = arena_memfd_create(size);
+	if (fd == -1)
+		return (r);
+	// Reserve both views in one go so nothing else can land in between
+	char *base = mmap(NULL, size * 2, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (base == MAP_FAILED)
+	{
+		close(fd);
+		return (r);
+	}
+	if (mmap(base, size, prot, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED
+		|| mmap(base + size, size, prot, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(base, size * 2);
+		close(fd);
+		return (r);
+	}
+	ASAN_POISON_MEMORY_REGION(base, size * 2);
+	r.base = base;
+	r.size = size;
+	r.fd = fd;
+	return (r);
+}
+
+void arena_ring_free(ArenaRing *r)
+{
+	if (r->base)
+		munmap(r->base, r->size * 2);
+	if (r->fd != -1)
+		close(r->fd);
+	r->base = NULL;
+	r->fd = -1;
+	r->head = 0;
+	r->tail = 0;
+}
+
+void *arena_ring_alloc(ArenaRing *r, size_t size)
+{
+	return (arena_ring_alloc_aligned(r, size, DEFAULT_ALIGNMENT));
+}
+
+/*
+   Every ring allocation is preceded by an 8-byte header holding the span of
+   the allocation (header included) with the low bit as a released flag.
+   Alignment gaps get a filler header that is released from the start, so
+   the consumer can always walk from the tail header to the next one.
+*/
+#define ARENA_RING_HEADER	sizeof(size_t)
+#define ARENA_RING_RELEASED	((size_t)1)
+
+// Headers are always accessed through the first view, so ASAN sees one address
+static size_t *arena_ring_header(ArenaRing *r, size_t pos)
+{
+	return ((size_t *)(r->base + (pos % r->size)));
+}
+
+static void arena_ring_write_header(ArenaRing *r, size_t pos, size_t value)
+{
+	size_t *header = arena_ring_header(r, pos);
+	ASAN_UNPOISON_MEMORY_REGION(header, ARENA_RING_HEADER);
+	*header = value;
+	ASAN_POISON_MEMORY_REGION(header, ARENA_RING_HEADER);
+}
+
+static size_t arena_ring_read_header(ArenaRing *r, size_t pos)
+{
+	size_t *header = arena_ring_header(r, pos);
+	ASAN_UNPOISON_MEMORY_REGION(header, ARENA_RING_HEADER);
+	size_t value = *header;
+	ASAN_POISON_MEMORY_REGION(header, ARENA_RING_HEADER);
+	return (value);
+}
+
+// Released bytes may have been handed out through either view
+static void arena_ring_poison(ArenaRing *r, size_t pos, size_t len)
+{
+	size_t start = pos % r->size;
+	ASAN_POISON_MEMORY_REGION(r->base + start, len);
+	ASAN_POISON_MEMORY_REGION(r->base + r->size + start,
+			(len < r->size - start) ? len : r->size - start);
+	if (start + len > r->size)
+		ASAN_POISON_MEMORY_REGION(r->base, start + len - r->size);
+	(void)start;
+}
+
+void *arena_ring_alloc_aligned(ArenaRing *r, size_t size, size_t align)
+{
+	if (size == 0 || !r->base)
+		return (NULL);
+	if (!is_power_of_two(align))
+		return (NULL);
+	if (align < ARENA_RING_HEADER)
+		align = ARENA_RING_HEADER;
+
+	size_t head = r->head;
+	size_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	uintptr_t current_addr = (uintptr_t)r->base + (head % r->size);
+	uintptr_t aligned_addr = align_forward(current_addr + ARENA_RING_HEADER, align);
+	size_t gap = aligned_addr - ARENA_RING_HEADER - current_addr;
+	size_t span = ARENA_RING_HEADER + align_forward(size, ARENA_RING_HEADER);
+
+	if (size > r->size || gap + span > r->size - (head - tail))
+		return (NULL);
+
+	// head stays 8-aligned, so a non-empty gap always fits a filler header
+	if (gap)
+		arena_ring_write_header(r, head, gap | ARENA_RING_RELEASED);
+	arena_ring_write_header(r, head + gap, span);
+
+	void *ptr = (void *)aligned_addr;
+	ASAN_UNPOISON_MEMORY_REGION(ptr, size);
+	__atomic_store_n(&r->head, head + gap + span, __ATOMIC_RELEASE);
+	return (ptr);
+}
+
+/*
+   Marks ptr as released. The tail only moves past allocations that are
+   released and contiguous with it, so out-of-order releases keep their
+   memory reserved until everything before them is released too.
+   Returns false if ptr is not a live allocation of this ring.
+*/
+bool arena_ring_release(ArenaRing *r, void *ptr)
+{
+	if (!ptr || !r->base)
+		return (false);
+	if ((char *)ptr < r->base + ARENA_RING_HEADER || (char *)ptr >= r->base + r->size * 2)
+		return (false);
+
+	size_t tail = r->tail;
+	size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	size_t header_offset = ((uintptr_t)ptr - ARENA_RING_HEADER - (uintptr_t)r->base) % r->size;
+	size_t dist = (header_offset + r->size - (tail % r->size)) % r->size;
+
+	if (dist >= head - tail)
+		return (false);
+	// Walk the headers from tail so an interior pointer is never taken for one
+	size_t at = tail;
+	while (at - tail < dist)
+		at += arena_ring_read_header(r, at) & ~ARENA_RING_RELEASED;
+	if (at - tail != dist)
+		return (false);
+	size_t header = arena_ring_read_header(r, tail + dist);
+	if (header & ARENA_RING_RELEASED)
+		return (false);
+	arena_ring_write_header(r, tail + dist, header | ARENA_RING_RELEASED);
+
+	while (tail != head)
+	{
+		header = arena_ring_read_header(r, tail);
+		if (!(header & ARENA_RING_RELEASED))
+			break;
+		size_t span = header & ~ARENA_RING_RELEASED;
+		arena_ring_poison(r, tail, span);
+		tail += span;
+	}
+	__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+	return (true);
+}
+
+size_t arena_ring_used(ArenaRing *r)
+{
+	size_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	return (head - tail);
+}
+
 size_t arena_total_used(Arena *a)
 {
     size_t total = 0;
@@ -411,18 +1098,27 @@ size_t arena_total_used(Arena *a)
         total += curr->offset;
         curr = curr->prev;
     }
+	for (curr = a->large; curr; curr = curr->prev)
+		total += curr->offset;
     return (total);
 }
 
 bool arena_set_prot(Arena *a, int prot)
 {
-    ArenaBlock *curr = a->curr;
-    while (curr)
+	for (int i = 0; i < 2; ++i)
 	{
-        if (mprotect(curr, curr->size, prot) == -1)
-			return (false);
-        curr = curr->prev;
-    }
+		ArenaBlock *curr = i ? a->large : a->curr;
+		while (curr)
+		{
+			// Caller-owned memory is left alone; it may not even be page aligned
+			if (!curr->borrowed && mprotect(curr, curr->size, prot) == -1)
+				return (false);
+#ifdef MEMARENA_GUARD_TEMP
+			arena_guard_reapply(curr);
+#endif
+			curr = curr->prev;
+		}
+	}
     a->prot = prot;
     return (true);
 }
@@ -441,6 +1137,12 @@ void arena_print_stats(Arena *a)
         block_count++;
         curr = curr->prev;
     }
+	for (curr = a->large; curr; curr = curr->prev)
+	{
+		total_capacity += curr->size;
+		total_used += curr->offset;
+		block_count++;
+	}
 
     printf("Arena Stats:\n");
     printf("  OS Page size: %zuKiB\n", get_page_size() / 1024);
@@ -0,0 +1,130 @@
+/*
+   ----------------------------------------------------------------------------
+   MEMARENA.HPP
+   ----------------------------------------------------------------------------
+   C++17 companion for memarena.h: std::pmr::memory_resource and allocator
+   adapters, plus an RAII scope around arena_temp_begin / arena_temp_end.
+
+   Author:  Juuso Rinta
+   Repo:    github.com/juusokasperi/memarena
+   License: MIT
+   ----------------------------------------------------------------------------
+
+   USAGE:
+     Define MEMARENA_IMPLEMENTATION in *one* .c file as usual, the
+     implementation is C and has to be compiled as such.
+
+     #include "memarena.hpp"
+
+     Arena a = arena_init(PROT_READ | PROT_WRITE);
+     memarena::MemoryResource res(&a);
+     std::pmr::vector<int> v(&res);
+*/
+
+#ifndef MEMARENA_HPP
+# define MEMARENA_HPP
+
+# include "memarena.h"
+
+# include <cstddef>
+# include <cstdint>
+# include <memory_resource>
+# include <new>
+
+namespace memarena {
+
+/*
+   Allocates from an Arena. Deallocation only gives memory back if it was the
+   most recent allocation (top-of-arena shrink in arena_realloc_aligned),
+   everything else is freed along with the arena.
+*/
+class MemoryResource : public std::pmr::memory_resource
+{
+public:
+	explicit MemoryResource(Arena *arena) noexcept : arena_(arena) {}
+
+	Arena	*arena() const noexcept { return (arena_); }
+
+private:
+	Arena	*arena_;
+
+	void *do_allocate(std::size_t bytes, std::size_t align) override
+	{
+		void *ptr = arena_alloc_aligned(arena_, bytes ? bytes : 1, align);
+		if (!ptr)
+			throw std::bad_alloc();
+		return (ptr);
+	}
+
+	void do_deallocate(void *ptr, std::size_t bytes, std::size_t align) override
+	{
+		arena_realloc_aligned(arena_, ptr, bytes ? bytes : 1, 0, align);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		const MemoryResource *res = dynamic_cast<const MemoryResource *>(&other);
+		return (res && res->arena_ == arena_);
+	}
+};
+
+// Plain allocator for non-pmr containers; copies compare equal per arena
+template <typename T>
+class Allocator
+{
+public:
+	using value_type = T;
+
+	explicit Allocator(Arena *arena) noexcept : arena_(arena) {}
+
+	template <typename U>
+	Allocator(const Allocator<U> &other) noexcept : arena_(other.arena()) {}
+
+	T *allocate(std::size_t n)
+	{
+		if (n > SIZE_MAX / sizeof(T))
+			throw std::bad_array_new_length();
+		std::size_t bytes = n ? n * sizeof(T) : 1;
+		void *ptr = arena_alloc_aligned(arena_, bytes, alignof(T));
+		if (!ptr)
+			throw std::bad_alloc();
+		return (static_cast<T *>(ptr));
+	}
+
+	void deallocate(T *ptr, std::size_t n) noexcept
+	{
+		std::size_t bytes = n ? n * sizeof(T) : 1;
+		arena_realloc_aligned(arena_, ptr, bytes, 0, alignof(T));
+	}
+
+	Arena	*arena() const noexcept { return (arena_); }
+
+	template <typename U>
+	bool operator==(const Allocator<U> &other) const noexcept { return (arena_ == other.arena()); }
+
+	template <typename U>
+	bool operator!=(const Allocator<U> &other) const noexcept { return (arena_ != other.arena()); }
+
+private:
+	Arena	*arena_;
+};
+
+// Rolls the arena back to where it was when the scope was entered
+class TempScope
+{
+public:
+	explicit TempScope(Arena *arena) noexcept : temp_(arena_temp_begin(arena)) {}
+	~TempScope() { arena_temp_end(temp_); }
+
+	TempScope(const TempScope &) = delete;
+	TempScope &operator=(const TempScope &) = delete;
+
+	Arena	*arena() const noexcept { return (temp_.arena); }
+
+private:
+	ArenaTemp	temp_;
+};
+
+} // namespace memarena
+
+#endif // MEMARENA_HPP
@@ -1,5 +1,15 @@
+#ifdef MEMARENA_GUARD_TEMP
+// Counts the arena's mprotect calls for test_guard
+# include <sys/mman.h>
+static size_t mprotect_calls;
+static int counted_mprotect(void *addr, size_t len, int prot);
+# define mprotect(addr, len, prot) counted_mprotect(addr, len, prot)
+#endif
+
 #define MEMARENA_IMPLEMENTATION
 #include "../memarena.h"
+#include <setjmp.h>
+#include <signal.h>
 
 // Run from root of repo:
 // cc (-DMEMARENA_DISABLE_RESIZE) -fsanitize=address -g tester/tester.c -o tester/memarena_tester
@@ -12,6 +22,10 @@
 #define FLAG_POISON 0x01 
 #define FLAG_ALIGN 0x02 
 #define FLAG_REALLOC 0x03
+#define FLAG_SNAPSHOT 0x04
+#define FLAG_RING 0x08
+#define FLAG_BUFFER 0x10
+#define FLAG_GUARD 0x20
 #define FLAG_ALL 0xFF
 
 static void page_alignment(void);
@@ -19,6 +33,10 @@ static void poison(void);
 static uint8_t check_flags(int argc, char **argv);
 static bool check_version_match(void);
 static void test_realloc(void);
+static void test_snapshot(void);
+static void test_ring(void);
+static void test_buffer(void);
+static void test_guard(void);
 
 int main(int argc, char **argv)
 {
@@ -29,6 +47,10 @@ int main(int argc, char **argv)
 	{
 		page_alignment();
 		test_realloc();
+		test_snapshot();
+		test_ring();
+		test_buffer();
+		test_guard();
 		return (0);
 	}
 	uint8_t flags = check_flags(argc, argv);
@@ -38,6 +60,14 @@ int main(int argc, char **argv)
 		poison();
 	if (flags & FLAG_REALLOC)
 		test_realloc();
+	if (flags & FLAG_SNAPSHOT)
+		test_snapshot();
+	if (flags & FLAG_RING)
+		test_ring();
+	if (flags & FLAG_BUFFER)
+		test_buffer();
+	if (flags & FLAG_GUARD)
+		test_guard();
     return (0);
 }
 
@@ -118,7 +148,12 @@ static void page_alignment(void)
     
     arena_print_stats(&a2);
     long page_size = sysconf(_SC_PAGESIZE);
+#if defined(MEMARENA_GUARD_PAGES) && !defined(MEMARENA_DISABLE_RESIZE)
+    // Large allocations get their own guarded block
+    size_t cap = a2.large->size;
+#else
     size_t cap = a2.curr->size;
+#endif
     if (cap % page_size == 0)
         printf("  \n%s>> SUCCESS: Block size %zu is perfectly divisible by page size %ld%s\n", GREEN_B, cap, page_size, RESET);
     else
@@ -131,15 +166,22 @@ static void page_alignment(void)
     printf("  >> Allocating 1KiB. Should fit in CURRENT block.%s\n", RESET);
     
     ArenaBlock *before_block = a2.curr;
-    arena_alloc(&a2, 1024);
+    char *slack = arena_alloc(&a2, 1024);
 
 #ifdef MEMARENA_DISABLE_RESIZE
-    if (a2.curr == before_block)
+    if (slack && a2.curr == before_block)
         printf("  %s>> SUCCESS: Allocation succeeded.%s\n", GREEN_B, RESET);
 	else
         printf("  %s>> FAIL: Allocation failed, pointer returned NULL.%s\n", RED_B, RESET);
+#elif defined(MEMARENA_GUARD_PAGES)
+    // The 64MB allocation only went to a2.large, so the 1KiB one opens the one regular block
+    if (!before_block && a2.large && !a2.large->prev && a2.curr && !a2.curr->prev
+        && slack >= (char *)a2.curr && slack + 1024 <= (char *)a2.curr + a2.curr->size)
+        printf("  %s>> SUCCESS: Large allocation was isolated in its own guarded block.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Allocated next to a guarded large allocation.%s\n", RED_B, RESET);
 #else
-    if (a2.curr == before_block)
+    if (slack && a2.curr == before_block)
         printf("  %s>> SUCCESS: Still in the same block! We used the slack space.%s\n", GREEN_B, RESET);
     else
         printf("  %s>> FAIL: Created a new block unnecessarily.%s\n", RED_B, RESET);
@@ -220,6 +262,330 @@ static void test_realloc(void)
     arena_free(&a);
 }
 
+static void test_snapshot(void)
+{
+	printf("%s=====================\n", GREEN_B);
+    printf("=== Snapshot Test ===\n");
+    printf("=====================%s\n", RESET);
+
+    Arena a = arena_init_cow(PROT_READ | PROT_WRITE);
+    int *value = arena_alloc(&a, sizeof(int));
+	if (!value)
+	{
+		printf("  %s>> FAIL: Allocating from COW arena failed.%s\n", RED_B, RESET);
+		return;
+	}
+    *value = 42;
+    size_t used_before = arena_total_used(&a);
+
+    // 1. Discard speculative work
+    printf("  %s>> Taking snapshot, mutating and restoring...%s\n", YELLOW, RESET);
+    ArenaSnapshot snap = arena_snapshot(&a);
+	if (!snap.arena)
+	{
+		printf("  %s>> FAIL: Taking snapshot failed.%s\n", RED_B, RESET);
+		arena_free(&a);
+		return;
+	}
+    *value = 1337;
+    arena_alloc(&a, 70 * 1024 * 1024);
+    arena_snapshot_restore(snap);
+
+    if (*value == 42 && arena_total_used(&a) == used_before)
+        printf("  %s>> SUCCESS: Value and usage restored at the same address.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Restore kept speculative changes (%d).%s\n", RED_B, *value, RESET);
+
+    // Data poisoned by a shrink after the snapshot must be readable again
+    printf("  %s>> Shrinking an allocation inside a snapshot and restoring...%s\n", YELLOW, RESET);
+    char *bytes = arena_alloc(&a, 64);
+    memset(bytes, 'x', 64);
+    snap = arena_snapshot(&a);
+    arena_realloc(&a, bytes, 64, 8);
+    arena_snapshot_restore(snap);
+    if (bytes[40] == 'x')
+        printf("  %s>> SUCCESS: Shrunk bytes are accessible again after restore.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Shrunk bytes were not restored.%s\n", RED_B, RESET);
+
+    // 2. Keep speculative work
+    printf("  %s>> Taking snapshot, mutating and committing...%s\n", YELLOW, RESET);
+    snap = arena_snapshot(&a);
+    *value = 7;
+    int *extra = arena_alloc(&a, sizeof(int));
+    *extra = 8;
+    arena_snapshot_commit(snap);
+
+    // A new snapshot + restore must come back to the committed state
+    snap = arena_snapshot(&a);
+    *value = 0;
+    arena_snapshot_restore(snap);
+    if (*value == 7 && *extra == 8)
+        printf("  %s>> SUCCESS: Committed changes survived a later restore.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Commit lost changes (%d, %d).%s\n", RED_B, *value, *extra, RESET);
+
+    arena_free(&a);
+}
+
+static void test_ring(void)
+{
+	printf("%s=================\n", GREEN_B);
+    printf("=== Ring Test ===\n");
+    printf("=================%s\n", RESET);
+
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    ArenaRing r = arena_ring_init(page_size, PROT_READ | PROT_WRITE);
+	if (!r.base)
+	{
+		printf("  %s>> FAIL: Mapping the ring failed.%s\n", RED_B, RESET);
+		return;
+	}
+
+    // 1. Fill the ring, it must refuse more than its capacity.
+    // Every allocation takes an extra 8-byte header.
+    printf("  %s>> Filling the ring (%zu bytes)...%s\n", YELLOW, r.size, RESET);
+    size_t chunk = page_size / 4 - sizeof(size_t);
+    char *first = arena_ring_alloc(&r, chunk);
+    char *second = arena_ring_alloc(&r, chunk);
+    arena_ring_alloc(&r, page_size / 2 - 64 - sizeof(size_t));
+    if (arena_ring_alloc(&r, 64) == NULL)
+        printf("  %s>> SUCCESS: Full ring returned NULL.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Ring allocated past its capacity.%s\n", RED_B, RESET);
+
+    // 2. Out-of-order release must not free the older, still live chunk
+    printf("  %s>> Releasing the second chunk before the first...%s\n", YELLOW, RESET);
+    arena_ring_release(&r, second);
+    if (arena_ring_used(&r) == page_size - 64 && arena_ring_alloc(&r, 64) == NULL)
+        printf("  %s>> SUCCESS: Tail stayed behind the live first chunk.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Out-of-order release freed live memory (%zu used).%s\n", RED_B, arena_ring_used(&r), RESET);
+    if (!arena_ring_release(&r, second))
+        printf("  %s>> SUCCESS: Double release was rejected.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Double release was accepted.%s\n", RED_B, RESET);
+    first[8] = 'x';
+    if (!arena_ring_release(&r, first + 16) && first[8] == 'x'
+		&& !arena_ring_release(&r, r.base + r.size * 2))
+        printf("  %s>> SUCCESS: Interior and out-of-range pointers were rejected.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: A pointer that isn't an allocation was released.%s\n", RED_B, RESET);
+
+    // 3. Releasing the first chunk frees both, the next allocation crosses the seam
+    printf("  %s>> Releasing the first chunk and allocating across the seam...%s\n", YELLOW, RESET);
+    arena_ring_release(&r, first);
+    if (arena_ring_used(&r) == page_size / 2 - 64)
+        printf("  %s>> SUCCESS: Tail advanced over both released chunks.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Unexpected used bytes (%zu).%s\n", RED_B, arena_ring_used(&r), RESET);
+    char *straddle = arena_ring_alloc(&r, chunk);
+    if (!straddle)
+	{
+        printf("  %s>> FAIL: Allocation after release failed.%s\n", RED_B, RESET);
+		arena_ring_free(&r);
+		return;
+	}
+    // The part past the end of the ring is the mirror of its start
+    memset(straddle, 0xAB, chunk);
+    if (straddle < r.base + r.size && straddle + chunk > r.base + r.size
+		&& (unsigned char)straddle[chunk - 1] == 0xAB)
+        printf("  %s>> SUCCESS: Allocation continued contiguously into the mirror.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Allocation did not wrap through the mirror.%s\n", RED_B, RESET);
+
+    if (arena_ring_used(&r) == page_size / 4 * 3 - 64)
+        printf("  %s>> SUCCESS: Used bytes tracked correctly (%zu).%s\n", GREEN_B, arena_ring_used(&r), RESET);
+    else
+        printf("  %s>> FAIL: Unexpected used bytes (%zu).%s\n", RED_B, arena_ring_used(&r), RESET);
+
+    arena_ring_free(&r);
+}
+
+static void test_buffer(void)
+{
+	printf("%s===================\n", GREEN_B);
+    printf("=== Buffer Test ===\n");
+    printf("===================%s\n", RESET);
+
+    char stack_buf[4096];
+    Arena a = arena_init_buffer(stack_buf, sizeof(stack_buf), PROT_READ | PROT_WRITE);
+
+    // 1. Small allocations come from the stack buffer
+    printf("  %s>> Allocating 1KiB from a 4KiB stack buffer...%s\n", YELLOW, RESET);
+    char *small = arena_alloc(&a, 1024);
+    if (small >= stack_buf && small + 1024 <= stack_buf + sizeof(stack_buf))
+        printf("  %s>> SUCCESS: Allocation lives in the caller's buffer.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Allocation did not use the caller's buffer.%s\n", RED_B, RESET);
+
+    // 2. Overflowing allocations spill into mmap'd blocks
+    printf("  %s>> Allocating 8KiB, which doesn't fit...%s\n", YELLOW, RESET);
+    char *big = arena_alloc(&a, 8192);
+#ifdef MEMARENA_DISABLE_RESIZE
+    if (big == NULL)
+        printf("  %s>> SUCCESS: Fixed mode refused to spill.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Fixed mode spilled out of the buffer.%s\n", RED_B, RESET);
+#else
+    if (big && (big < stack_buf || big >= stack_buf + sizeof(stack_buf)))
+        printf("  %s>> SUCCESS: Allocation spilled into a new block.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Spill allocation failed.%s\n", RED_B, RESET);
+#endif
+
+    // 3. Reset and free must not unmap the stack
+    printf("  %s>> Resetting and freeing the arena...%s\n", YELLOW, RESET);
+    arena_reset(&a);
+    if (arena_alloc(&a, 16) == small)
+        printf("  %s>> SUCCESS: Reset returned to the caller's buffer.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Reset did not return to the caller's buffer.%s\n", RED_B, RESET);
+    arena_free(&a);
+    // These bytes were poisoned by the arena, ASAN aborts here unless arena_free unpoisoned them
+    small[1023] = 'x';
+    stack_buf[sizeof(stack_buf) - 1] = 'x';
+    printf("  %s>> SUCCESS: Stack buffer still usable after arena_free.%s\n", GREEN_B, RESET);
+}
+
+// Fault helpers for test_guard; its temp check is skipped under ASAN
+#if defined(MEMARENA_GUARD_PAGES) \
+	|| (defined(MEMARENA_GUARD_TEMP) && !defined(__SANITIZE_ADDRESS__))
+static sigjmp_buf guard_jmp;
+
+static void guard_handler(int sig)
+{
+	(void)sig;
+	siglongjmp(guard_jmp, 1);
+}
+
+// Returns true if writing to addr raises SIGSEGV
+static bool write_faults(volatile char *addr)
+{
+	struct sigaction sa = {0};
+	struct sigaction old_segv, old_bus;
+	sa.sa_handler = guard_handler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGSEGV, &sa, &old_segv);
+	sigaction(SIGBUS, &sa, &old_bus);
+
+	bool faulted = true;
+	if (sigsetjmp(guard_jmp, 1) == 0)
+	{
+		*addr = 1;
+		faulted = false;
+	}
+	sigaction(SIGSEGV, &old_segv, NULL);
+	sigaction(SIGBUS, &old_bus, NULL);
+	return (faulted);
+}
+#endif
+
+#ifdef MEMARENA_GUARD_TEMP
+static int counted_mprotect(void *addr, size_t len, int prot)
+{
+	mprotect_calls++;
+	return ((mprotect)(addr, len, prot));
+}
+#endif
+
+static void test_guard(void)
+{
+	printf("%s==================\n", GREEN_B);
+    printf("=== Guard Test ===\n");
+    printf("==================%s\n", RESET);
+
+#if !defined(MEMARENA_GUARD_PAGES) && !defined(MEMARENA_GUARD_TEMP)
+    printf("  %s>> Skipped, compile with -DMEMARENA_GUARD_PAGES and/or -DMEMARENA_GUARD_TEMP%s\n", YELLOW, RESET);
+#else
+    Arena a = arena_init(PROT_READ | PROT_WRITE);
+    char *first = arena_alloc(&a, 64);
+	if (!first)
+	{
+		printf("  %s>> FAIL: Allocating from the arena failed.%s\n", RED_B, RESET);
+		return;
+	}
+# if defined(MEMARENA_GUARD_PAGES) && !defined(MEMARENA_DISABLE_RESIZE)
+    // Interleaved small and large allocations must keep sharing one regular block
+    printf("  %s>> Interleaving 20 small and 20 large allocations...%s\n", YELLOW, RESET);
+    size_t regular_blocks = 0;
+    size_t large_blocks = 0;
+    {
+        Arena mixed = arena_init(PROT_READ | PROT_WRITE);
+        for (int i = 0; i < 20; ++i)
+        {
+            arena_alloc(&mixed, 64);
+            arena_alloc(&mixed, MEMARENA_GUARD_LARGE_SIZE);
+        }
+        for (ArenaBlock *b = mixed.curr; b; b = b->prev)
+            regular_blocks++;
+        for (ArenaBlock *b = mixed.large; b; b = b->prev)
+            large_blocks++;
+        arena_free(&mixed);
+    }
+    if (regular_blocks == 1 && large_blocks == 20)
+        printf("  %s>> SUCCESS: Small allocations stayed in one block (%zu + %zu guarded).%s\n", GREEN_B, regular_blocks, large_blocks, RESET);
+    else
+        printf("  %s>> FAIL: Expected 1 + 20 blocks, got %zu + %zu.%s\n", RED_B, regular_blocks, large_blocks, RESET);
+# endif
+# ifdef MEMARENA_GUARD_PAGES
+    // 1. Writing one byte past the end of the block must fault
+    printf("  %s>> Writing past the end of the block...%s\n", YELLOW, RESET);
+    if (write_faults((char *)a.curr + a.curr->size))
+        printf("  %s>> SUCCESS: Block overrun hit the guard page.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Block overrun went unnoticed.%s\n", RED_B, RESET);
+
+#  ifndef MEMARENA_DISABLE_RESIZE
+    // 2. Large allocations end right at a guard page
+    printf("  %s>> Writing past the end of a large allocation...%s\n", YELLOW, RESET);
+    size_t large_size = MEMARENA_GUARD_LARGE_SIZE;
+    char *large = arena_alloc(&a, large_size);
+    if (large && write_faults(large + large_size))
+        printf("  %s>> SUCCESS: Large allocation overrun hit the guard page.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Large allocation overrun went unnoticed.%s\n", RED_B, RESET);
+#  endif
+# endif
+# if defined(MEMARENA_GUARD_TEMP) && !defined(__SANITIZE_ADDRESS__)
+    // 3. Rolled-back temp memory is inaccessible until it is reused
+    // (skipped under ASAN, which reports the poisoned access before the fault)
+    printf("  %s>> Accessing memory after arena_temp_end...%s\n", YELLOW, RESET);
+    ArenaTemp temp = arena_temp_begin(&a);
+    char *scratch = arena_alloc(&a, 64);
+    arena_temp_end(temp);
+    if (write_faults(scratch))
+        printf("  %s>> SUCCESS: Use after rollback faulted.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Use after rollback went unnoticed.%s\n", RED_B, RESET);
+
+    char *reused = arena_alloc(&a, 64);
+    if (reused == scratch && !write_faults(reused))
+        printf("  %s>> SUCCESS: Rolled-back memory is usable again once reallocated.%s\n", GREEN_B, RESET);
+    else
+        printf("  %s>> FAIL: Reallocated memory is not usable.%s\n", RED_B, RESET);
+# endif
+# ifdef MEMARENA_GUARD_TEMP
+    // 4. Refilling a rolled-back scope must not cost an mprotect per page
+    printf("  %s>> Refilling 20 temp scopes with 4096 x 256B each...%s\n", YELLOW, RESET);
+    mprotect_calls = 0;
+    for (int i = 0; i < 20; ++i)
+    {
+        ArenaTemp scope = arena_temp_begin(&a);
+        for (int j = 0; j < 4096; ++j)
+            arena_alloc(&a, 256);
+        arena_temp_end(scope);
+    }
+    // 1MiB per scope: one rollback plus a few doubling steps, not 256 pages
+    if (mprotect_calls <= 20 * 8)
+        printf("  %s>> SUCCESS: %zu mprotect calls for 20 scopes.%s\n", GREEN_B, mprotect_calls, RESET);
+    else
+        printf("  %s>> FAIL: %zu mprotect calls for 20 scopes.%s\n", RED_B, mprotect_calls, RESET);
+# endif
+    arena_free(&a);
+#endif
+}
+
 static uint8_t check_flags(int argc, char **argv)
 {
 	uint8_t flags = 0;
@@ -235,6 +601,14 @@ static uint8_t check_flags(int argc, char **argv)
 			flags |= FLAG_ALIGN;
 		else if (strcmp(argv[i], "--realloc") == 0)
 			flags |= FLAG_REALLOC;
+		else if (strcmp(argv[i], "--snapshot") == 0)
+			flags |= FLAG_SNAPSHOT;
+		else if (strcmp(argv[i], "--ring") == 0)
+			flags |= FLAG_RING;
+		else if (strcmp(argv[i], "--buffer") == 0)
+			flags |= FLAG_BUFFER;
+		else if (strcmp(argv[i], "--guard") == 0)
+			flags |= FLAG_GUARD;
 		else if (strcmp(argv[i], "--all") == 0)
 			flags = FLAG_ALL;
 		else if (strcmp(argv[i], "--help") == 0)
@@ -242,8 +616,8 @@ static uint8_t check_flags(int argc, char **argv)
 			if (!help_printed)
 			{
 				printf("%sHow to use tester:%s\n", GREEN_B, RESET);
-				printf("Accepts flags --poison, --align, --realloc, --all, --help\n");
-				printf("By default, runs with --align and --realloc\n");
+				printf("Accepts flags --poison, --align, --realloc, --snapshot, --ring, --buffer, --guard, --all, --help\n");
+				printf("By default, runs with --align, --realloc, --snapshot, --ring, --buffer and --guard\n");
 				printf("Remember to compile with -g and -fsanitize=address for the poison test\n");
 				help_printed = true;
 			}
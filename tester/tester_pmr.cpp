@@ -0,0 +1,132 @@
+#include "../memarena.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Run from root of repo; the implementation is built as C:
+// cc -x c -DMEMARENA_IMPLEMENTATION -c memarena.h -o tester/memarena.o
+// c++ -std=c++17 -g tester/tester_pmr.cpp tester/memarena.o -o tester/memarena_tester_pmr
+
+#define YELLOW "\033[0;93m"
+#define GREEN_B "\033[1;92m"
+#define RED_B "\033[1;91m"
+#define RESET "\033[0m"
+
+static bool in_arena(Arena *a, const void *ptr);
+static void test_memory_resource(void);
+static void test_allocator(void);
+static void test_temp_scope(void);
+
+int main(void)
+{
+	test_memory_resource();
+	test_allocator();
+	test_temp_scope();
+	return (0);
+}
+
+static bool in_arena(Arena *a, const void *ptr)
+{
+	for (ArenaBlock *curr = a->curr; curr; curr = curr->prev)
+	{
+		const char *base = (const char *)curr;
+		if ((const char *)ptr >= base && (const char *)ptr < base + curr->size)
+			return (true);
+	}
+	return (false);
+}
+
+static void test_memory_resource(void)
+{
+	printf("%s=============================\n", GREEN_B);
+	printf("=== Memory Resource Test ===\n");
+	printf("=============================%s\n", RESET);
+
+	Arena a = arena_init(PROT_READ | PROT_WRITE);
+	{
+		memarena::MemoryResource res(&a);
+
+		// 1. Containers allocate from the arena
+		printf("  %s>> Filling pmr::vector and pmr::unordered_map...%s\n", YELLOW, RESET);
+		std::pmr::vector<int> numbers(&res);
+		std::pmr::unordered_map<int, std::pmr::string> names(&res);
+		for (int i = 0; i < 1000; ++i)
+		{
+			numbers.push_back(i);
+			names.emplace(i, "a string long enough to skip small string optimization");
+		}
+		if (in_arena(&a, numbers.data()) && in_arena(&a, names.at(500).data()))
+			printf("  %s>> SUCCESS: Container storage lives in the arena.%s\n", GREEN_B, RESET);
+		else
+			printf("  %s>> FAIL: Container storage is not in the arena.%s\n", RED_B, RESET);
+
+		// 2. Deallocating the top of the arena gives the memory back
+		printf("  %s>> Deallocating the most recent allocation...%s\n", YELLOW, RESET);
+		size_t used_before = arena_total_used(&a);
+		void *top = res.allocate(4096, 64);
+		res.deallocate(top, 4096, 64);
+		if (arena_total_used(&a) <= used_before + 64)
+			printf("  %s>> SUCCESS: Top-of-arena deallocation shrank the arena.%s\n", GREEN_B, RESET);
+		else
+			printf("  %s>> FAIL: Deallocation did not shrink the arena.%s\n", RED_B, RESET);
+
+		memarena::MemoryResource other(&a);
+		if (res.is_equal(other))
+			printf("  %s>> SUCCESS: Resources over the same arena compare equal.%s\n", GREEN_B, RESET);
+		else
+			printf("  %s>> FAIL: Resources over the same arena differ.%s\n", RED_B, RESET);
+	}
+	arena_free(&a);
+}
+
+static void test_allocator(void)
+{
+	printf("%s======================\n", GREEN_B);
+	printf("=== Allocator Test ===\n");
+	printf("======================%s\n", RESET);
+
+	Arena a = arena_init(PROT_READ | PROT_WRITE);
+	{
+		printf("  %s>> Filling std::vector with memarena::Allocator...%s\n", YELLOW, RESET);
+		memarena::Allocator<double> alloc(&a);
+		std::vector<double, memarena::Allocator<double>> values(alloc);
+		for (int i = 0; i < 1000; ++i)
+			values.push_back(i * 0.5);
+		if (in_arena(&a, values.data()) && values[999] == 499.5)
+			printf("  %s>> SUCCESS: Vector storage lives in the arena.%s\n", GREEN_B, RESET);
+		else
+			printf("  %s>> FAIL: Vector storage is not in the arena.%s\n", RED_B, RESET);
+
+		memarena::Allocator<int> rebound(alloc);
+		if (rebound == alloc)
+			printf("  %s>> SUCCESS: Rebound allocator compares equal.%s\n", GREEN_B, RESET);
+		else
+			printf("  %s>> FAIL: Rebound allocator differs.%s\n", RED_B, RESET);
+	}
+	arena_free(&a);
+}
+
+static void test_temp_scope(void)
+{
+	printf("%s=======================\n", GREEN_B);
+	printf("=== Temp Scope Test ===\n");
+	printf("=======================%s\n", RESET);
+
+	Arena a = arena_init(PROT_READ | PROT_WRITE);
+	arena_alloc(&a, 64);
+	size_t used_before = arena_total_used(&a);
+	{
+		printf("  %s>> Allocating inside a TempScope...%s\n", YELLOW, RESET);
+		memarena::TempScope scope(&a);
+		memarena::MemoryResource res(&a);
+		std::pmr::vector<int> scratch(10000, 0, &res);
+	}
+	if (arena_total_used(&a) <= used_before + (size_t)sysconf(_SC_PAGESIZE))
+		printf("  %s>> SUCCESS: Leaving the scope rolled the arena back.%s\n", GREEN_B, RESET);
+	else
+		printf("  %s>> FAIL: Arena still holds %zu bytes.%s\n", RED_B, arena_total_used(&a), RESET);
+	arena_free(&a);
+}